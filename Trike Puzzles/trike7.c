@@ -72,6 +72,29 @@ typedef uint_fast64_t hash_t;   /* 64 bits unsigned integer */
 #define MIN_MOVES     8 /* Minimum required number of legal moves       */
 #define MIN_REPLIES   4 /* Minimum required number of legal replies     */
 
+#define ADAPTIVE  false /* Sample seeds until every TARGET is reached   */
+#define NUM_SEEDS 10000 /* Maximum number of adaptive seeds drawn       */
+#define MIN_SEED      8 /* Minimum number of pieces of an adaptive seed */
+#define MAX_SEED     14 /* Maximum number of pieces of an adaptive seed */
+#define EXPLORE      10 /* One adaptive seed in EXPLORE is fully random */
+
+#if MAX_SEED > 28 - MIN_REGION
+#error "Seeds with more than 28 - MIN_REGION pieces can never hold a problem"
+#endif
+
+#define ENDGAME      10 /* Maximum region size solved without the cache */
+
+#if ENDGAME >= MIN_REGION
+#error "ENDGAME positions are never written, so it must be below MIN_REGION"
+#endif
+
+/* `TARGET[height]` is the number of adaptive problems wanted per height
+   (heights above 28 - MIN_SEED are ignored: no seed has room for them) */
+const size_t TARGET[29] = {  0,  0,  0,  0,  0,  0,  0,  0,
+                            10, 10, 10, 10, 10, 10, 10, 10,
+                            10, 10,  0,  0,  0,  0,  0,
+                             0,  0,  0,  0,  0,  0};
+
 /* `N[direction][index]` is the `neighbor` of `index` in that `direction` */
 const uint_t N[7][29] = {{ 0,               1,
                                           2,  3,
@@ -135,9 +158,11 @@ hash_t hash(uint_t *board, uint_t value) {
     /* Encode the value */
     hash_t h = ((hash_t) value);
 
-    /* Encode the pawn position */
-    h |= ((hash_t) 1) << ( 7 + board[0]);
-    h |= ((hash_t) 1) << (35 + board[0]);
+    /* Encode the pawn position (there is none in the empty board) */
+    if (board[0]) {
+        h |= ((hash_t) 1) << ( 7 + board[0]);
+        h |= ((hash_t) 1) << (35 + board[0]);
+    }
 
     /* Encode the rest of the pieces */
     for (uint_t i = 1; i <= 28; i++) {
@@ -204,10 +229,50 @@ uint_t component_size(uint_t *board, uint_t cell) {
     return size;
 }
 
+/* The number of empty cells reachable by the pawn (stops after `limit`) */
+uint_t region_size(uint_t *board, uint_t limit) {
+
+    uint_t Q[29], next, size;       /* Queue */
+    uint_t i, C[29];                /* candidates */
+
+    /* Particular case: the empty board */
+    if (board[0] == 0) { return limit; }
+
+    /* Initialize candidates */
+    for (i = 1; i <= 28; i++) { C[i] = board[i] ? 0 : 1; }
+    C[0] = 0;
+
+    /* Breath first search (the pawn itself is not counted) */
+    next = size = 0;
+    Q[size++] = board[0];
+    while (next < size && size <= limit) {
+        i = Q[next++];
+        if (C[N[1][i]]) { C[N[1][i]] = 0; Q[size++] = N[1][i]; }
+        if (C[N[2][i]]) { C[N[2][i]] = 0; Q[size++] = N[2][i]; }
+        if (C[N[3][i]]) { C[N[3][i]] = 0; Q[size++] = N[3][i]; }
+        if (C[N[4][i]]) { C[N[4][i]] = 0; Q[size++] = N[4][i]; }
+        if (C[N[5][i]]) { C[N[5][i]] = 0; Q[size++] = N[5][i]; }
+        if (C[N[6][i]]) { C[N[6][i]] = 0; Q[size++] = N[6][i]; }
+    }
+
+    return size - 1;
+}
+
 
 
 /*** INTERFACE ***************************************************************/
 
+/* `found[height]` is the number of problems written so far per height */
+size_t found[29];
+
+/* Returns the smallest height whose TARGET isn't reached yet (or 0) */
+uint_t unfilled(void) {
+    for (uint_t h = MIN_PLIES; h <= MAX_PLIES && h <= 28 - MIN_SEED; h++) {
+        if (found[h] < TARGET[h]) { return h; }
+    }
+    return 0;
+}
+
 /* Prints a `(board), pawn, win_move, height` line in the standar output */
 void write(uint_t *board, uint_t win_move, uint_t height) {
 
@@ -216,6 +281,7 @@ void write(uint_t *board, uint_t win_move, uint_t height) {
     row[board[0]] |= 4;
     row[win_move] |= 4;
     
+    found[height]++;
     printf("# %02d-", (int) height);
     for (int i = 1; i <= 28; i++) { printf("%d", row[i]); }
     printf("\n");
@@ -313,16 +379,133 @@ uint_t get_winner(uint_t *board) {
     else                     { return 0; }
 }
 
+/* Stores in `values` the `value` of every end-game child and 0 otherwise */
+uint_t get_leaves(uint_t *board, uint_t *moves, uint_t num_moves,
+                  uint_t *values) {
+
+    uint_t B[29];                   /* Copy of the board with a wall in B[0] */
+    uint_t i, m, c, open, first, second, leaves = 0;
+    uint_t next = board[0] ? 3-board[board[0]] : 1;
+
+    /* The missing neighbors N[d][c] == 0 become occupied cells of no color */
+    for (i = 1; i <= 28; i++) { B[i] = board[i]; }
+    B[0] = 3;
+
+    /* One pass over the whole batch of children, without calling solve() */
+    for (m = 0; m < num_moves; m++) {
+        c      = moves[m];
+        open   = 0;
+        first  = (next == 1);
+        second = (next == 2);
+        for (uint_t d = 1; d <= 6; d++) {
+            i       = N[d][c];
+            open   |= (B[i] == 0);
+            first  += (B[i] == 1);
+            second += (B[i] == 2);
+        }
+
+        /* Pawn and neighbors are an odd number of cells: there are no ties */
+        values[m] = open ? 0 : (first > second) ? 1 : 2;
+        leaves   += !open;
+    }
+    return leaves;
+}
+
+uint_t solve(uint_t *board, stree *cache);
+uint_t solve_endgame(uint_t *board);
+
+/* Returns the `value` of a mid-game position from the values of its `moves`
+   and stores its optimal move in `win_move` (a NULL `cache` means ENDGAME) */
+uint_t solve_moves(uint_t *board, uint_t *moves, uint_t num_moves,
+                   stree *cache, uint_t *win_move) {
+
+    uint_t m, leaves[12], num_leaves;
+    uint_t move_value, value;
+    uint_t height     = 0;   /*  # of remaining plies with perfect play  */
+    uint_t unique     = 0;   /*  1 <=> there is exactly one winning move */
+    uint_t pawn = board[0];
+    uint_t next = pawn ? 3-board[pawn] : 1;
+
+    /* Evaluate all the end-game children at once */
+    num_leaves = get_leaves(board, moves, num_moves, leaves);
+
+    *win_move = 0;
+    for (m = 0; m < num_moves; m++) {
+
+        /* End-game child: skip the recursion and the cache */
+        if (num_leaves && leaves[m]) { move_value = leaves[m]; }
+
+        /* Mid-game child: recourse */
+        else {
+            board[moves[m]] = next;
+            board[0]        = moves[m];
+            move_value      = cache ? solve(board, cache)
+                                    : solve_endgame(board);
+            board[0]        = pawn;
+            board[moves[m]] = 0;
+        }
+
+        /* If it's a winning move... */
+        if ((move_value & 3) == next) {
+
+            /* ...and it's the first one */
+            if (*win_move == 0) {
+                height    = ((move_value >> 3) + 1);
+                *win_move = moves[m];
+                unique    = 1;
+            }
+
+            /* ...and it isn't the first one */
+            else {
+                unique = 0;
+                if (((move_value >> 3) + 1) < height) {
+                    height    = ((move_value >> 3) + 1);
+                    *win_move = moves[m];
+                }
+            }
+        }
+
+        /* If it's a losing move... */
+        else if (*win_move == 0 && ((move_value >> 3) + 1) > height) {
+            height = ((move_value >> 3) + 1);
+        }
+    }
+
+    /* Compute value of current position */
+    value  = *win_move ? next : 3-next;   /*  bit structure of `value`  */
+    value |= (unique << 2);               /*      8 7 6 5 4 3 2 1       */
+    value |= (height << 3);               /*      <-height> u win       */
+    return value;
+}
+
+/* Returns the `value` of a position whose region has at most ENDGAME cells */
+uint_t solve_endgame(uint_t *board) {
+
+    uint_t win_move, moves[12];
+    uint_t num_moves = get_moves(board, moves);
+
+    /* End-game position: return the winner */
+    if (num_moves == 0) { return get_winner(board); }
+
+    /* Mid-game position: recourse without touching the cache */
+    return solve_moves(board, moves, num_moves, NULL, &win_move);
+}
+
 /* Returns the `value` of a mid-game position */
 uint_t solve(uint_t *board, stree *cache) {
 
+    /* Small regions can't hold a problem: solve them without the cache */
+    if (region_size(board, ENDGAME+1) <= ENDGAME) {
+        return solve_endgame(board);
+    }
+
     /* Try to recover the value from the cache */
     hash_t h     = hash(board, 0);
     uint_t value =  get(cache, h);
     if (value) { return value; }
 
     /* Otherwise we need to compute the value */
-    uint_t m, moves[12];
+    uint_t moves[12];
     uint_t num_moves = get_moves(board, moves);
 
     /* End-game position: return the winner */
@@ -332,46 +515,14 @@ uint_t solve(uint_t *board, stree *cache) {
     else {
         uint_t empty_cells = 0;
         uint_t replies[12], num_replies = 0;
-        uint_t move_value;
-        uint_t win_move   = 0;   /*  Optimal move from this position         */
-        uint_t height     = 0;   /*  # of remaining plies with perfect play  */
-        uint_t unique     = 0;   /*  1 <=> there is exactly one winning move */
-        uint_t pawn = board[0];
-        uint_t next = pawn ? 3-board[pawn] : 1;
-
-        for (m = 0; m < num_moves; m++) {
+        uint_t win_move;
+        uint_t pawn   = board[0];
+        uint_t next   = pawn ? 3-board[pawn] : 1;
 
-            board[moves[m]] = next;
-            board[0]        = moves[m];
-            move_value      = solve(board, cache);
-            board[0]        = pawn;
-            board[moves[m]] = 0;
-
-            /* If it's a winning move... */
-            if ((move_value & 3) == next) {
+        value = solve_moves(board, moves, num_moves, cache, &win_move);
 
-                /* ...and it's the first one */
-                if (win_move == 0) {
-                    height   = ((move_value >> 3) + 1);
-                    win_move = moves[m];
-                    unique   = 1;
-                }
-
-                /* ...and it isn't the first one */
-                else {
-                    unique = 0;
-                    if (((move_value >> 3) + 1) < height) {
-                        height   = ((move_value >> 3) + 1);
-                        win_move = moves[m];
-                    }
-                }
-            }
-
-            /* If it's a losing move... */
-            else if (win_move == 0 && ((move_value >> 3) + 1) > height) {
-                height = ((move_value >> 3) + 1);
-            }
-        }
+        uint_t unique = (value >> 2) & 1;
+        uint_t height = (value >> 3);
 
         /* Get additional information */
         if (unique) { 
@@ -386,14 +537,10 @@ uint_t solve(uint_t *board, stree *cache) {
         /* Output selected problems */
         if (unique                 && MIN_REGION  <= empty_cells &&
             MIN_MOVES <= num_moves && MIN_REPLIES <= num_replies &&
-            MIN_PLIES <= height    && height <= MAX_PLIES) {
+            MIN_PLIES <= height    && height <= MAX_PLIES  &&
+            (!ADAPTIVE || found[height] < TARGET[height])) {
             write(board, win_move, height);
         }
-
-        /* Compute value of current position */
-        value  =  win_move ? next : 3-next;   /*  bit structure of `value`  */
-        value |= (unique << 2);               /*      8 7 6 5 4 3 2 1       */
-        value |= (height << 3);               /*      <-height> u win       */
     }
 
     /* Store and return the value */
@@ -412,6 +559,21 @@ void play_random(uint_t *board) {
 
 
 
+/*** ADAPTIVE SAMPLING *******************************************************/
+
+/* Only the seed depth adapts online: the seeds themselves are random games
+   and the region filter of main() is fixed (it only drops hopeless seeds) */
+
+/* Optimistic estimate of the useful problems per CPU-second of a seed depth:
+   one free problem at the start, fading by a 10ms pseudo-cost per seed and
+   scaled by the fraction of its `seeds` that were good enough to be `solved` */
+double yield(size_t problems, size_t solved, size_t seeds, clock_t spent) {
+    return (problems + 1.0) / (spent + (seeds+1.0) * CLOCKS_PER_SEC / 100.0)
+         * (solved + 1.0) / (seeds + 1.0);
+}
+
+
+
 /*** MAIN FUNCTION ***********************************************************/
 
 int main() {
@@ -420,6 +582,58 @@ int main() {
     uint_t  i, board[29];
     srand(time(0));
 
+    /* Sample seed depths by their yield of wanted problems per CPU-second */
+    if (ADAPTIVE) {
+        size_t  seeds[MAX_SEED+1]  = {0}, solved[MAX_SEED+1] = {0};
+        size_t  useful[MAX_SEED+1] = {0}, before, drawn = 0;
+        clock_t spent[MAX_SEED+1]  = {0}, start;
+        uint_t  d, seed, needed;
+
+        /* Only the solved seeds count as trials, but all of them are capped */
+        for (size_t g = 0; g < NUM_TRIALS && drawn < NUM_SEEDS &&
+                           (needed = unfilled()); drawn++) {
+
+            /* Pick the best seed depth (or a random one, from time to time) */
+            seed = MIN_SEED + rand_size_t(MAX_SEED - MIN_SEED + 1);
+            if (rand_size_t(EXPLORE)) {
+                for (d = MIN_SEED; d <= MAX_SEED; d++) {
+                    if (yield(useful[d], solved[d], seeds[d], spent[d]) >
+                        yield(useful[seed], solved[seed],
+                              seeds[seed],  spent[seed])) {
+                        seed = d;
+                    }
+                }
+            }
+
+            start = clock();
+            for (i = 0; i <= 28; i++)  { board[i] = 0;       }
+            for (i = 0; i < seed; i++) { play_random(board); }
+
+            /* Heights and regions only shrink: skip the hopeless seeds
+               (a fixed filter, not an adaptive bias of the seed selection) */
+            if (needed < MIN_REGION) { needed = MIN_REGION; }
+            if (region_size(board, needed) >= needed) {
+                for (before = d = 0; d <= 28; d++) { before += found[d]; }
+                solve(board, &cache);
+                clear(&cache);
+                for (d = 0; d <= 28; d++) { useful[seed] += found[d]; }
+                useful[seed] -= before;
+                solved[seed]++;
+                g++;
+            }
+            spent[seed] += clock() - start;
+            seeds[seed]++;
+        }
+
+        /* Report the observed yield of every seed depth */
+        for (d = MIN_SEED; d <= MAX_SEED; d++) {
+            fprintf(stderr, "%2d plies: %6zu seeds %6zu solved %6zu problems"
+                    " %9.2f s\n", (int) d, seeds[d], solved[d], useful[d],
+                    (double) spent[d] / CLOCKS_PER_SEC);
+        }
+        return EXIT_SUCCESS;
+    }
+
     for (size_t g = 0; g < NUM_TRIALS; g++) {
         for (i = 0; i <= 28; i++)        { board[i] = 0;       }
         for (i = 0; i < SEED_PLIES; i++) { play_random(board); }